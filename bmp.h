@@ -1,5 +1,8 @@
 // BMP-related data types based on Microsoft's own
 
+#ifndef BMP_H
+#define BMP_H
+
 #include <stdint.h>
 
 /**
@@ -73,3 +76,28 @@ typedef struct
     BYTE  rgbtRed;
 } __attribute__((__packed__))
 RGBTRIPLE;
+
+/**
+ * RGBQUAD
+ *
+ * This structure describes a color table (palette) entry of an indexed
+ * DIB [device-independent bitmap].
+ *
+ * Adapted from http://msdn.microsoft.com/en-us/library/dd162938(VS.85).aspx.
+ */
+typedef struct
+{
+    BYTE  rgbBlue;
+    BYTE  rgbGreen;
+    BYTE  rgbRed;
+    BYTE  rgbReserved;
+} __attribute__((__packed__))
+RGBQUAD;
+
+/**
+ * Compression values for BITMAPINFOHEADER.biCompression
+ */
+#define BI_RGB  0
+#define BI_RLE8 1
+
+#endif // BMP_H
@@ -0,0 +1,473 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bmpio.h"
+
+// Read an 8-bit pixel array (BI_RGB or BI_RLE8) and expand it through the palette
+// Rows land in file order, just like 24-bit rows; pixels RLE8 skips over stay palette entry 0
+static int readIndexed(FILE *inptr, const BITMAPFILEHEADER *bf, const BITMAPINFOHEADER *bi, int height, int width, RGBTRIPLE (*image)[width])
+{
+    // The palette follows the info header; biClrUsed of 0 means a full 256 entries
+    RGBQUAD palette[256] = {{0}};
+    int colors = (bi->biClrUsed > 0 && bi->biClrUsed < 256) ? bi->biClrUsed : 256;
+    fseek(inptr, sizeof(BITMAPFILEHEADER) + bi->biSize, SEEK_SET);
+    if (fread(palette, sizeof(RGBQUAD), colors, inptr) != colors)
+    {
+        return 6;
+    }
+
+    BYTE *indices = calloc((size_t)height * width, 1);
+    if (indices == NULL)
+    {
+        printf("Not enough memory to store image.\n");
+        return 7;
+    }
+
+    fseek(inptr, bf->bfOffBits, SEEK_SET);
+    if (bi->biCompression == BI_RGB)
+    {
+        // Rows are padded to a multiple of 4 bytes
+        int padding = (4 - width % 4) % 4;
+        for (int i = 0; i < height; i++)
+        {
+            fread(indices + (size_t)i * width, 1, width, inptr);
+            fseek(inptr, padding, SEEK_CUR);
+        }
+    }
+    else
+    {
+        // RLE8: (count, index) runs, or an escape 0 followed by end of line (0), end of bitmap (1),
+        // delta (2, dx, dy) or an absolute run (n >= 3, then n indices padded to a 16-bit boundary)
+        int i = 0, j = 0;
+        int first, second;
+        while (i < height && (first = fgetc(inptr)) != EOF && (second = fgetc(inptr)) != EOF)
+        {
+            if (first > 0)
+            {
+                for (int k = 0; k < first && j < width; k++)
+                {
+                    indices[(size_t)i * width + j++] = second;
+                }
+            }
+            else if (second == 0)
+            {
+                i++;
+                j = 0;
+            }
+            else if (second == 1)
+            {
+                break;
+            }
+            else if (second == 2)
+            {
+                int dx = fgetc(inptr);
+                int dy = fgetc(inptr);
+                if (dx == EOF || dy == EOF)
+                {
+                    break;
+                }
+                j += dx;
+                i += dy;
+            }
+            else
+            {
+                for (int k = 0; k < second; k++)
+                {
+                    int index = fgetc(inptr);
+                    if (j < width && i < height)
+                    {
+                        indices[(size_t)i * width + j++] = (index == EOF) ? 0 : index;
+                    }
+                }
+                if (second % 2 != 0)
+                {
+                    fgetc(inptr);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            RGBQUAD color = palette[indices[(size_t)i * width + j]];
+            image[i][j].rgbtRed = color.rgbRed;
+            image[i][j].rgbtGreen = color.rgbGreen;
+            image[i][j].rgbtBlue = color.rgbBlue;
+        }
+    }
+    free(indices);
+    return 0;
+}
+
+int readBMP(const char *path, BITMAPFILEHEADER *bf, BITMAPINFOHEADER *bi, RGBTRIPLE **pixels)
+{
+    // Open input file
+    FILE *inptr = fopen(path, "r");
+    if (inptr == NULL)
+    {
+        printf("Could not open %s.\n", path);
+        return 4;
+    }
+
+    // Read infile's BITMAPFILEHEADER and BITMAPINFOHEADER (first 40 bytes)
+    if (fread(bf, sizeof(BITMAPFILEHEADER), 1, inptr) != 1 ||
+        fread(bi, sizeof(BITMAPINFOHEADER), 1, inptr) != 1)
+    {
+        fclose(inptr);
+        printf("Unsupported file format.\n");
+        return 6;
+    }
+
+    // Ensure infile is a valid 24-bit uncompressed or 8-bit uncompressed/RLE8 BMP (supports BMP 3.0, 4.0, and 5.0)
+    bool truecolor = (bi->biBitCount == 24 && bi->biCompression == BI_RGB);
+    bool indexed = (bi->biBitCount == 8 && (bi->biCompression == BI_RGB || bi->biCompression == BI_RLE8));
+    if (bf->bfType != 0x4d42 || !(truecolor || indexed))
+    {
+        fclose(inptr);
+        printf("Unsupported file format.\n");
+        return 6;
+    }
+
+    // Validate header size (must be at least 40 bytes for basic BITMAPINFOHEADER)
+    if (bi->biSize < 40)
+    {
+        fclose(inptr);
+        printf("Invalid BMP header size.\n");
+        return 6;
+    }
+
+    // Get image's dimensions
+    int height = abs(bi->biHeight);
+    int width = bi->biWidth;
+
+    // Allocate memory for image, zeroed so short files don't leave garbage
+    RGBTRIPLE(*image)[width] = calloc(height, width * sizeof(RGBTRIPLE));
+    if (image == NULL)
+    {
+        printf("Not enough memory to store image.\n");
+        fclose(inptr);
+        return 7;
+    }
+
+    if (indexed)
+    {
+        int status = readIndexed(inptr, bf, bi, height, width, image);
+        fclose(inptr);
+        if (status != 0)
+        {
+            if (status == 6)
+            {
+                printf("Unsupported file format.\n");
+            }
+            free(image);
+            return status;
+        }
+        *pixels = &image[0][0];
+        return 0;
+    }
+
+    // Position file pointer at pixel data (handles variable header sizes)
+    fseek(inptr, bf->bfOffBits, SEEK_SET);
+
+    // Determine padding for scanlines
+    int padding = (4 - (width * sizeof(RGBTRIPLE)) % 4) % 4;
+
+    // Iterate over infile's scanlines
+    for (int i = 0; i < height; i++)
+    {
+        // Read row into pixel array
+        fread(image[i], sizeof(RGBTRIPLE), width, inptr);
+
+        // Skip over padding
+        fseek(inptr, padding, SEEK_CUR);
+    }
+
+    fclose(inptr);
+    *pixels = &image[0][0];
+    return 0;
+}
+
+int writeBMP(const char *path, BITMAPFILEHEADER bf, BITMAPINFOHEADER bi, int height, int width, int stride, const RGBTRIPLE *pixels)
+{
+    // Replace rather than truncate an existing output: it may be a hard link into the result cache
+    remove(path);
+
+    // Open output file
+    FILE *outptr = fopen(path, "w");
+    if (outptr == NULL)
+    {
+        printf("Could not create %s.\n", path);
+        return 5;
+    }
+
+    // Ensure output is in BMP 3.0 format for maximum compatibility
+    bi.biSize = 40;  // Standard BITMAPINFOHEADER size
+    bf.bfOffBits = 54;  // Standard offset for BMP 3.0
+    bi.biWidth = width;
+    bi.biBitCount = 24;
+    bi.biCompression = BI_RGB;
+    bi.biClrUsed = 0;
+    bi.biClrImportant = 0;
+
+    // Recalculate file size for BMP 3.0 format
+    int padding = (4 - (width * sizeof(RGBTRIPLE)) % 4) % 4;
+    int imageSize = (width * sizeof(RGBTRIPLE) + padding) * height;
+    bi.biSizeImage = imageSize;
+    bf.bfSize = 54 + imageSize;  // 54 bytes for headers + image data
+
+    // Write outfile's BITMAPFILEHEADER
+    fwrite(&bf, sizeof(BITMAPFILEHEADER), 1, outptr);
+
+    // Write outfile's BITMAPINFOHEADER
+    fwrite(&bi, sizeof(BITMAPINFOHEADER), 1, outptr);
+
+    for (int i = 0; i < height; i++)
+    {
+        // Write row to outfile
+        fwrite(pixels + (long)i * stride, sizeof(RGBTRIPLE), width, outptr);
+
+        // Write padding at end of row
+        for (int k = 0; k < padding; k++)
+        {
+            fputc(0x00, outptr);
+        }
+    }
+
+    fclose(outptr);
+    return 0;
+}
+
+// INDEXED OUTPUT
+// Grayscale images (every pixel has R == G == B, as after -g) map exactly onto a 256-level gray
+// palette. Anything else goes through a fixed 6x7x6 color cube (252 entries; green gets the extra
+// level since the eye is most sensitive to it), optionally with 4x4 ordered dithering.
+
+#define CUBE_RED 6
+#define CUBE_GREEN 7
+#define CUBE_BLUE 6
+
+// 4x4 Bayer matrix, thresholds 0..15
+static const int bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5},
+};
+
+// Quantize one channel value to one of levels steps; threshold (0..15, or 8 for no dither)
+// shifts the rounding point within the step
+static inline int quantize(int value, int levels, int threshold)
+{
+    int level = (value * (levels - 1) * 16 + threshold * 255) / (255 * 16);
+    return level < levels - 1 ? level : levels - 1;
+}
+
+static bool isGray(int height, int width, int stride, const RGBTRIPLE *pixels)
+{
+    for (int i = 0; i < height; i++)
+    {
+        const RGBTRIPLE *row = pixels + (long)i * stride;
+        for (int j = 0; j < width; j++)
+        {
+            if (row[j].rgbtRed != row[j].rgbtGreen || row[j].rgbtGreen != row[j].rgbtBlue)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Append one RLE8-encoded row (including its end-of-line escape) to out; returns bytes written
+// Runs of 2 or more identical indices are encoded, everything between goes into absolute runs
+static int encodeRowRLE8(const BYTE *row, int width, BYTE *out)
+{
+    int n = 0;
+    int j = 0;
+    while (j < width)
+    {
+        int run = 1;
+        while (j + run < width && run < 255 && row[j + run] == row[j])
+        {
+            run++;
+        }
+        if (run >= 2)
+        {
+            out[n++] = run;
+            out[n++] = row[j];
+            j += run;
+            continue;
+        }
+
+        // Gather literals up to the next repeat
+        int literal = 1;
+        while (j + literal < width && literal < 255 &&
+               !(j + literal + 1 < width && row[j + literal] == row[j + literal + 1]))
+        {
+            literal++;
+        }
+        if (literal < 3)
+        {
+            // Absolute runs need at least 3 bytes; shorter ones are runs of 1
+            for (int k = 0; k < literal; k++)
+            {
+                out[n++] = 1;
+                out[n++] = row[j + k];
+            }
+        }
+        else
+        {
+            out[n++] = 0;
+            out[n++] = literal;
+            for (int k = 0; k < literal; k++)
+            {
+                out[n++] = row[j + k];
+            }
+            if (literal % 2 != 0)
+            {
+                out[n++] = 0;
+            }
+        }
+        j += literal;
+    }
+    out[n++] = 0;
+    out[n++] = 0;
+    return n;
+}
+
+int writeBMP8(const char *path, BITMAPFILEHEADER bf, BITMAPINFOHEADER bi, int height, int width, int stride, const RGBTRIPLE *pixels, bool dither, bool rle)
+{
+    // Build the palette and map every pixel to an index
+    RGBQUAD palette[256] = {{0}};
+    int colors;
+    bool gray = isGray(height, width, stride, pixels);
+    if (gray)
+    {
+        colors = 256;
+        for (int v = 0; v < 256; v++)
+        {
+            palette[v] = (RGBQUAD) { v, v, v, 0 };
+        }
+    }
+    else
+    {
+        colors = CUBE_RED * CUBE_GREEN * CUBE_BLUE;
+        for (int r = 0; r < CUBE_RED; r++)
+        {
+            for (int g = 0; g < CUBE_GREEN; g++)
+            {
+                for (int b = 0; b < CUBE_BLUE; b++)
+                {
+                    palette[(r * CUBE_GREEN + g) * CUBE_BLUE + b] = (RGBQUAD) {
+                        b * 255 / (CUBE_BLUE - 1), g * 255 / (CUBE_GREEN - 1), r * 255 / (CUBE_RED - 1), 0
+                    };
+                }
+            }
+        }
+    }
+
+    BYTE *indices = malloc((size_t)height * width);
+    // Worst case RLE8 row: 2 bytes per pixel plus the end-of-line escape
+    BYTE *encoded = rle ? malloc((size_t)height * (2 * width + 2) + 2) : NULL;
+    if (indices == NULL || (rle && encoded == NULL))
+    {
+        free(indices);
+        free(encoded);
+        printf("Not enough memory to store image.\n");
+        return 7;
+    }
+
+    for (int i = 0; i < height; i++)
+    {
+        const RGBTRIPLE *row = pixels + (long)i * stride;
+        BYTE *out = indices + (size_t)i * width;
+        for (int j = 0; j < width; j++)
+        {
+            if (gray)
+            {
+                out[j] = row[j].rgbtRed;
+            }
+            else
+            {
+                int threshold = dither ? bayer[i % 4][j % 4] : 8;
+                int r = quantize(row[j].rgbtRed, CUBE_RED, threshold);
+                int g = quantize(row[j].rgbtGreen, CUBE_GREEN, threshold);
+                int b = quantize(row[j].rgbtBlue, CUBE_BLUE, threshold);
+                out[j] = (r * CUBE_GREEN + g) * CUBE_BLUE + b;
+            }
+        }
+    }
+
+    // RLE8 bitmaps must be bottom-up, so a top-down image is written with its rows reversed
+    int imageSize;
+    int padding = (4 - width % 4) % 4;
+    if (rle)
+    {
+        bool topDown = bi.biHeight < 0;
+        imageSize = 0;
+        for (int n = 0; n < height; n++)
+        {
+            int i = topDown ? height - 1 - n : n;
+            imageSize += encodeRowRLE8(indices + (size_t)i * width, width, encoded + imageSize);
+        }
+        // End of bitmap
+        encoded[imageSize++] = 0;
+        encoded[imageSize++] = 1;
+        bi.biHeight = height;
+    }
+    else
+    {
+        imageSize = (width + padding) * height;
+    }
+
+    // Replace rather than truncate an existing output: it may be a hard link into the result cache
+    remove(path);
+
+    FILE *outptr = fopen(path, "w");
+    if (outptr == NULL)
+    {
+        free(indices);
+        free(encoded);
+        printf("Could not create %s.\n", path);
+        return 5;
+    }
+
+    // BMP 3.0 headers followed by the palette
+    int paletteSize = colors * sizeof(RGBQUAD);
+    bi.biSize = 40;
+    bi.biWidth = width;
+    bi.biBitCount = 8;
+    bi.biCompression = rle ? BI_RLE8 : BI_RGB;
+    bi.biSizeImage = imageSize;
+    bi.biClrUsed = colors;
+    bi.biClrImportant = 0;
+    bf.bfOffBits = 54 + paletteSize;
+    bf.bfSize = 54 + paletteSize + imageSize;
+
+    fwrite(&bf, sizeof(BITMAPFILEHEADER), 1, outptr);
+    fwrite(&bi, sizeof(BITMAPINFOHEADER), 1, outptr);
+    fwrite(palette, sizeof(RGBQUAD), colors, outptr);
+
+    if (rle)
+    {
+        fwrite(encoded, 1, imageSize, outptr);
+    }
+    else
+    {
+        for (int i = 0; i < height; i++)
+        {
+            fwrite(indices + (size_t)i * width, 1, width, outptr);
+            for (int k = 0; k < padding; k++)
+            {
+                fputc(0x00, outptr);
+            }
+        }
+    }
+
+    fclose(outptr);
+    free(indices);
+    free(encoded);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef BMPIO_H
+#define BMPIO_H
+
+#include <stdbool.h>
+
+#include "bmp.h"
+
+// Read a 24-bit uncompressed, or 8-bit uncompressed or RLE8 BMP (BMP 3.0, 4.0 or 5.0 headers)
+// On success *pixels holds height rows of width pixels, expanded through the palette if indexed,
+// and must be freed by the caller
+// Returns 0, or the exit code for the failure: 4 can't open, 6 unsupported format, 7 out of memory
+int readBMP(const char *path, BITMAPFILEHEADER *bf, BITMAPINFOHEADER *bi, RGBTRIPLE **pixels);
+
+// Write the first width columns of an image whose rows are stride pixels apart as a 24-bit BMP 3.0
+// The other header fields (height sign, resolution) are taken from bf and bi
+// Returns 0, or 5 if the file can't be created
+int writeBMP(const char *path, BITMAPFILEHEADER bf, BITMAPINFOHEADER bi, int height, int width, int stride, const RGBTRIPLE *pixels);
+
+// Write the same image as an 8-bit indexed BMP 3.0, optionally BI_RLE8 compressed
+// Grayscale images get an exact gray palette; color ones a 6x7x6 color cube, optionally dithered
+// Returns 0, 5 if the file can't be created, or 7 if out of memory
+int writeBMP8(const char *path, BITMAPFILEHEADER bf, BITMAPINFOHEADER bi, int height, int width, int stride, const RGBTRIPLE *pixels, bool dither, bool rle);
+
+#endif // BMPIO_H
@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+
+// RESULT CACHE
+// Outputs live in a flat directory as <16 hex digit key>.bmp, plus a "stats" file with the hit and
+// miss counters. Keys come from the pixels rather than the path, so a resubmitted input hits no
+// matter where it was read from. Hits hard-link the entry to the output (copying when the two are
+// on different filesystems) and touch it, so modification time doubles as last use for eviction.
+// Entries are read-only, so a linked output can't be rewritten in place and corrupt the entry;
+// it has to be replaced (unlinked and recreated) instead, as writeBMP() does.
+
+// Bump whenever a filter's output changes, so stale entries stop matching
+#define CACHE_VERSION 1
+
+#define KEY_PRIME1 0x9e3779b185ebca87ULL
+#define KEY_PRIME2 0xc2b2ae3d27d4eb4fULL
+
+// Fold bytes into the hash 8 at a time (multiply-rotate, in the style of xxHash)
+static uint64_t hashBytes(uint64_t h, const void *data, size_t length)
+{
+    const unsigned char *p = data;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h ^= word * KEY_PRIME2;
+        h = ((h << 31) | (h >> 33)) * KEY_PRIME1;
+        p += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        h ^= *p * KEY_PRIME1;
+        h = ((h << 11) | (h >> 53)) * KEY_PRIME2;
+        p++;
+        length--;
+    }
+    return h;
+}
+
+uint64_t cacheKey(const BITMAPINFOHEADER *bi, const RGBTRIPLE *pixels, const char *params)
+{
+    int32_t fields[5] = { CACHE_VERSION, bi->biWidth, bi->biHeight, bi->biXPelsPerMeter, bi->biYPelsPerMeter };
+    uint64_t h = hashBytes(KEY_PRIME1, fields, sizeof(fields));
+    h = hashBytes(h, params, strlen(params));
+    h = hashBytes(h, pixels, (size_t)abs(bi->biHeight) * bi->biWidth * sizeof(RGBTRIPLE));
+
+    // Final avalanche (splitmix64)
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static void entryPath(char *path, size_t size, const char *dir, uint64_t key)
+{
+    snprintf(path, size, "%s/%016llx.bmp", dir, (unsigned long long)key);
+}
+
+// Copy a file byte for byte; returns false if either side can't be opened or written
+static bool copyFile(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "r");
+    if (in == NULL) {
+        return false;
+    }
+    FILE *out = fopen(to, "w");
+    if (out == NULL) {
+        fclose(in);
+        return false;
+    }
+
+    char buffer[65536];
+    size_t n;
+    bool ok = true;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, n, out) != n) {
+            ok = false;
+            break;
+        }
+    }
+    fclose(in);
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+bool cacheFetch(const char *dir, uint64_t key, const char *outfile)
+{
+    char path[4096];
+    entryPath(path, sizeof(path), dir, key);
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+
+    // Replace rather than overwrite the output, then link or copy the entry into place
+    unlink(outfile);
+    if (link(path, outfile) != 0 && !copyFile(path, outfile)) {
+        return false;
+    }
+
+    // Mark as recently used
+    utimensat(AT_FDCWD, path, NULL, 0);
+    return true;
+}
+
+typedef struct
+{
+    char name[32];
+    long long size;
+    struct timespec used;
+} CacheEntry;
+
+static int compareUsed(const void *a, const void *b)
+{
+    const CacheEntry *x = a, *y = b;
+    if (x->used.tv_sec != y->used.tv_sec) {
+        return (x->used.tv_sec > y->used.tv_sec) - (x->used.tv_sec < y->used.tv_sec);
+    }
+    return (x->used.tv_nsec > y->used.tv_nsec) - (x->used.tv_nsec < y->used.tv_nsec);
+}
+
+// Delete least recently used entries until the total size fits in maxBytes
+static void evict(const char *dir, long long maxBytes)
+{
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+
+    CacheEntry *entries = NULL;
+    int count = 0, capacity = 0;
+    long long total = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        // Only touch files that look like cache entries
+        if (strlen(e->d_name) != 20 || strcmp(e->d_name + 16, ".bmp") != 0) {
+            continue;
+        }
+        char path[4096];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntry *grown = realloc(entries, capacity * sizeof(CacheEntry));
+            if (grown == NULL) {
+                break;
+            }
+            entries = grown;
+        }
+        memcpy(entries[count].name, e->d_name, 21);
+        entries[count].size = st.st_size;
+        entries[count].used = st.st_mtim;
+        total += st.st_size;
+        count++;
+    }
+    closedir(d);
+
+    if (total > maxBytes) {
+        qsort(entries, count, sizeof(CacheEntry), compareUsed);
+        for (int n = 0; n < count && total > maxBytes; n++) {
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", dir, entries[n].name);
+            if (unlink(path) == 0) {
+                total -= entries[n].size;
+            }
+        }
+    }
+    free(entries);
+}
+
+void cacheStore(const char *dir, uint64_t key, const char *outfile, long long maxBytes)
+{
+    mkdir(dir, 0755);
+
+    // Copy under a temporary name, make it read-only and rename, so concurrent runs never see a
+    // partial entry. A copy rather than a link, since the output may be rewritten in place later.
+    char path[4096], temp[4096 + 32];
+    entryPath(path, sizeof(path), dir, key);
+    snprintf(temp, sizeof(temp), "%s.tmp%ld", path, (long)getpid());
+    if (!copyFile(outfile, temp) || chmod(temp, 0444) != 0 || rename(temp, path) != 0) {
+        unlink(temp);
+        fprintf(stderr, "Could not store result in cache %s\n", dir);
+        return;
+    }
+
+    evict(dir, maxBytes);
+}
+
+void cacheCount(const char *dir, bool hit, unsigned long *hits, unsigned long *misses)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/stats", dir);
+
+    *hits = 0;
+    *misses = 0;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return;
+    }
+
+    // Hold a write lock across the read-modify-write so concurrent runs don't lose counts
+    struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = 0, .l_len = 0 };
+    while (fcntl(fd, F_SETLKW, &lock) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return;
+        }
+    }
+
+    char buffer[64];
+    ssize_t n = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (n > 0) {
+        buffer[n] = '\0';
+        if (sscanf(buffer, "hits %lu misses %lu", hits, misses) != 2) {
+            *hits = 0;
+            *misses = 0;
+        }
+    }
+
+    if (hit) {
+        (*hits)++;
+    } else {
+        (*misses)++;
+    }
+
+    int length = snprintf(buffer, sizeof(buffer), "hits %lu misses %lu\n", *hits, *misses);
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, buffer, length, 0) != length) {
+        fprintf(stderr, "Could not update cache statistics in %s\n", dir);
+    }
+
+    // Closing the descriptor releases the lock
+    close(fd);
+}
@@ -0,0 +1,25 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bmp.h"
+
+// Default size bound for the cache directory
+#define CACHE_DEFAULT_MAX_MB 1024
+
+// Key for one run: hash of the pixel data and the header fields that reach the output,
+// mixed with a description of the filter and its parameters
+uint64_t cacheKey(const BITMAPINFOHEADER *bi, const RGBTRIPLE *pixels, const char *params);
+
+// Serve outfile from the cache; returns true on a hit
+bool cacheFetch(const char *dir, uint64_t key, const char *outfile);
+
+// Store outfile under key, then evict least recently used entries until the cache fits in maxBytes
+void cacheStore(const char *dir, uint64_t key, const char *outfile, long long maxBytes);
+
+// Count a hit or a miss and report the running totals
+void cacheCount(const char *dir, bool hit, unsigned long *hits, unsigned long *misses);
+
+#endif // CACHE_H
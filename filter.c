@@ -1,36 +1,350 @@
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "bmpio.h"
+#include "cache.h"
 #include "helpers.h"
 
+// Long-only options get values outside the char range
+#define OPT_DEADLINE 256
+#define OPT_SEQUENCE 257
+#define OPT_SEAM_BAND 258
+#define OPT_SCENE_CUT 259
+#define OPT_CACHE 260
+#define OPT_CACHE_MAX 261
+#define OPT_INDEXED 262
+#define OPT_DITHER 263
+#define OPT_RLE 264
+#define OPT_GRAY_EDGES 265
+
+// Defaults for sequence mode
+#define DEFAULT_SEAM_BAND 4
+#define DEFAULT_SCENE_CUT 30.0
+
+// Everything the selected filter needs besides the image
+typedef struct
+{
+    char filter;
+    int compressPercent;
+    long deadlineMs;
+    bool equalizeLuma;
+    int medianRadius;
+    bool grayEdges;     // collapse edges to gray (strongest channel)
+} FilterOptions;
+
+// How the result is written
+typedef struct
+{
+    bool indexed;   // 8-bit palettized instead of 24-bit
+    bool dither;    // ordered dithering when a color palette is needed
+    bool rle;       // BI_RLE8 compression (implies indexed)
+} OutputFormat;
+
+// Write the first width columns of the filtered image in the requested format
+static int writeOutput(const OutputFormat *format, const char *path, BITMAPFILEHEADER bf, BITMAPINFOHEADER bi, int height, int width, int stride, const RGBTRIPLE *pixels)
+{
+    if (format->indexed || format->rle) {
+        return writeBMP8(path, bf, bi, height, width, stride, pixels, format->dither, format->rle);
+    }
+    return writeBMP(path, bf, bi, height, width, stride, pixels);
+}
+
+// Apply the selected filter in place; returns the output width
+// strategy reports how seam carving was done (always SEAM_FULL unless a deadline forced a fallback)
+static int applyFilter(const FilterOptions *options, int height, int width, RGBTRIPLE image[height][width], SeamStrategy *strategy)
+{
+    int newWidth = width; // Track the new width after seam carving
+    *strategy = SEAM_FULL;
+
+    switch (options->filter)
+    {
+        // Blur
+        case 'b':
+            blur(height, width, image);
+            break;
+
+        // Edges
+        case 'e':
+            edges(height, width, image);
+            if (options->grayEdges) {
+                edgesToGray(height, width, image);
+            }
+            break;
+
+        // Grayscale
+        case 'g':
+            grayscale(height, width, image);
+            break;
+
+        // Reflect
+        case 'r':
+            reflect(height, width, image);
+            break;
+
+        // Median
+        case 'm':
+            median(height, width, image, options->medianRadius);
+            break;
+
+        // Histogram equalization
+        case 'H':
+            equalize(height, width, image, options->equalizeLuma);
+            break;
+
+        // Auto-levels
+        case 'L':
+            autoLevels(height, width, image);
+            break;
+
+        // Seam carving
+        case 's':
+            if (options->deadlineMs > 0) {
+                newWidth = seamCarveDeadline(height, width, image, options->compressPercent, options->deadlineMs, strategy);
+                printf("Seam carving strategy: %s\n", seamStrategyName(*strategy));
+            } else {
+                newWidth = seamCarve(height, width, image, options->compressPercent);
+            }
+            break;
+    }
+    return newWidth;
+}
+
+// A frame pattern must contain exactly one integer conversion such as %d or %04d (and no other
+// conversions, since it is handed to snprintf)
+static bool validPattern(const char *pattern)
+{
+    int conversions = 0;
+    for (const char *p = pattern; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        if (p[1] == '%') {
+            p++;
+            continue;
+        }
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        if (*p != 'd') {
+            return false;
+        }
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+// Process numbered frames from first until the next input is missing
+// For seam carving, each frame's seams guide the next frame's search unless the frames differ by
+// more than sceneCut (mean absolute difference per channel), which forces a full search
+static int runSequence(const FilterOptions *options, const OutputFormat *format, const char *inPattern, const char *outPattern, int first, int band, double sceneCut)
+{
+    char infile[4096];
+    char outfile[4096];
+    RGBTRIPLE *previous = NULL;  // unfiltered copy of the last frame
+    int *seams = NULL;
+    int prevHeight = 0, prevWidth = 0;
+    int frames = 0;
+    int status = 0;
+
+    for (int n = first; ; n++) {
+        snprintf(infile, sizeof(infile), inPattern, n);
+        snprintf(outfile, sizeof(outfile), outPattern, n);
+
+        // The sequence ends at the first missing frame
+        FILE *probe = fopen(infile, "r");
+        if (probe == NULL) {
+            if (frames == 0) {
+                printf("Could not open %s.\n", infile);
+                status = 4;
+            }
+            break;
+        }
+        fclose(probe);
+
+        BITMAPFILEHEADER bf;
+        BITMAPINFOHEADER bi;
+        RGBTRIPLE *pixels;
+        status = readBMP(infile, &bf, &bi, &pixels);
+        if (status != 0) {
+            break;
+        }
+        int height = abs(bi.biHeight);
+        int width = bi.biWidth;
+        RGBTRIPLE (*image)[width] = (RGBTRIPLE (*)[width]) pixels;
+        int newWidth = width;
+
+        if (options->filter == 's') {
+            bool sameSize = (previous != NULL && height == prevHeight && width == prevWidth);
+            double difference = sameSize ? frameDifference(height, width, (RGBTRIPLE (*)[width]) previous, image) : 0;
+            bool guided = sameSize && difference <= sceneCut;
+
+            // Keep the unfiltered frame to compare the next one against
+            if (!sameSize) {
+                free(previous);
+                free(seams);
+                previous = malloc(height * width * sizeof(RGBTRIPLE));
+                seams = malloc(height * width * sizeof(int));
+                if (previous == NULL || seams == NULL) {
+                    printf("Not enough memory to store image.\n");
+                    free(pixels);
+                    status = 7;
+                    break;
+                }
+                prevHeight = height;
+                prevWidth = width;
+            }
+            memcpy(previous, pixels, height * width * sizeof(RGBTRIPLE));
+
+            newWidth = seamCarveGuided(height, width, image, options->compressPercent, seams, guided, band);
+            if (guided) {
+                printf("Frame %d: guided search (difference %.2f)\n", n, difference);
+            } else if (sameSize) {
+                printf("Frame %d: full search (difference %.2f above %.2f)\n", n, difference, sceneCut);
+            } else {
+                printf("Frame %d: full search\n", n);
+            }
+        } else {
+            SeamStrategy strategy;
+            newWidth = applyFilter(options, height, width, image, &strategy);
+        }
+
+        status = writeOutput(format, outfile, bf, bi, height, newWidth, width, pixels);
+        free(pixels);
+        if (status != 0) {
+            break;
+        }
+        frames++;
+    }
+
+    printf("Processed %d frames\n", frames);
+    free(previous);
+    free(seams);
+    return status;
+}
+
 int main(int argc, char *argv[])
 {
     // Define allowable filters (s: means s takes an argument)
-    char *filters = "begrs:";
-    int compressPercent = 0;
+    char *filters = "begrs:H:Lm:";
+    struct option longOptions[] = {
+        {"deadline-ms", required_argument, NULL, OPT_DEADLINE},
+        {"sequence", required_argument, NULL, OPT_SEQUENCE},
+        {"seam-band", required_argument, NULL, OPT_SEAM_BAND},
+        {"scene-cut", required_argument, NULL, OPT_SCENE_CUT},
+        {"cache", required_argument, NULL, OPT_CACHE},
+        {"cache-max-mb", required_argument, NULL, OPT_CACHE_MAX},
+        {"indexed", no_argument, NULL, OPT_INDEXED},
+        {"dither", no_argument, NULL, OPT_DITHER},
+        {"rle", no_argument, NULL, OPT_RLE},
+        {"gray-edges", no_argument, NULL, OPT_GRAY_EDGES},
+        {NULL, 0, NULL, 0}
+    };
+    FilterOptions options = {0};
+    OutputFormat format = {0};
+    bool sequence = false;
+    int firstFrame = 0;
+    int seamBand = DEFAULT_SEAM_BAND;
+    double sceneCut = DEFAULT_SCENE_CUT;
+    bool seamReuseTuned = false;  // --seam-band or --scene-cut given
+    char *cacheDir = NULL;
+    long long cacheMaxMb = CACHE_DEFAULT_MAX_MB;
     int seamCarving = 0;
-    char filter = 0;
 
     // Get filter flag and check validity
     int opt;
-    while ((opt = getopt(argc, argv, filters)) != -1) {
+    while ((opt = getopt_long(argc, argv, filters, longOptions, NULL)) != -1) {
         switch (opt) {
             case 'b':
             case 'e':
             case 'g':
             case 'r':
-                filter = opt;
+            case 'L':
+                options.filter = opt;
+                break;
+            case 'H':
+                options.filter = opt;
+                if (strcmp(optarg, "luma") == 0) {
+                    options.equalizeLuma = true;
+                } else if (strcmp(optarg, "rgb") == 0) {
+                    options.equalizeLuma = false;
+                } else {
+                    printf("Equalization mode must be rgb or luma.\n");
+                    return 1;
+                }
                 break;
             case 's':
-                filter = opt;
+                options.filter = opt;
                 seamCarving = 1;
-                compressPercent = atoi(optarg);  // optarg contains the argument after -s
-                if (compressPercent < 1 || compressPercent > 99) {
+                options.compressPercent = atoi(optarg);  // optarg contains the argument after -s
+                if (options.compressPercent < 1 || options.compressPercent > 99) {
                     printf("Compression percentage must be between 1 and 99.\n");
                     return 8;
                 }
                 break;
+            case 'm':
+                options.filter = opt;
+                options.medianRadius = atoi(optarg);
+                if (options.medianRadius < 1 || options.medianRadius > 15) {
+                    printf("Median radius must be between 1 and 15.\n");
+                    return 8;
+                }
+                break;
+            case OPT_DEADLINE:
+                options.deadlineMs = atol(optarg);
+                if (options.deadlineMs < 1) {
+                    printf("Deadline must be a positive number of milliseconds.\n");
+                    return 8;
+                }
+                break;
+            case OPT_SEQUENCE:
+                sequence = true;
+                firstFrame = atoi(optarg);
+                if (firstFrame < 0) {
+                    printf("First frame number must not be negative.\n");
+                    return 8;
+                }
+                break;
+            case OPT_SEAM_BAND:
+                seamBand = atoi(optarg);
+                seamReuseTuned = true;
+                if (seamBand < 1) {
+                    printf("Seam band must be at least 1 column.\n");
+                    return 8;
+                }
+                break;
+            case OPT_SCENE_CUT:
+                sceneCut = atof(optarg);
+                seamReuseTuned = true;
+                if (sceneCut < 0) {
+                    printf("Scene cut threshold must not be negative.\n");
+                    return 8;
+                }
+                break;
+            case OPT_CACHE:
+                cacheDir = optarg;
+                break;
+            case OPT_CACHE_MAX:
+                cacheMaxMb = atoll(optarg);
+                if (cacheMaxMb < 1) {
+                    printf("Cache size must be at least 1 MB.\n");
+                    return 8;
+                }
+                break;
+            case OPT_INDEXED:
+                format.indexed = true;
+                break;
+            case OPT_DITHER:
+                format.dither = true;
+                break;
+            case OPT_RLE:
+                format.rle = true;
+                break;
+            case OPT_GRAY_EDGES:
+                options.grayEdges = true;
+                break;
             case '?':
                 printf("Invalid filter.\n");
                 return 1;
@@ -38,23 +352,66 @@ int main(int argc, char *argv[])
     }
 
     // Check if a filter was selected
-    if (filter == 0) {
+    if (options.filter == 0) {
         printf("Must specify a filter.\n");
         return 1;
     }
 
+    // The deadline only applies to seam carving
+    if (options.deadlineMs > 0 && !seamCarving) {
+        printf("--deadline-ms requires seam carving (-s).\n");
+        return 1;
+    }
+
+    // Seam reuse settings only apply to seam carving a sequence
+    if (seamReuseTuned && !(seamCarving && sequence)) {
+        printf("--seam-band and --scene-cut require seam carving a sequence (-s with --sequence).\n");
+        return 1;
+    }
+
+    // Sequences reuse seams across frames, which a deadline can't account for
+    if (options.deadlineMs > 0 && sequence) {
+        printf("--deadline-ms can't be combined with --sequence.\n");
+        return 1;
+    }
+
+    // Gray edges only apply to edge detection
+    if (options.grayEdges && options.filter != 'e') {
+        printf("--gray-edges requires edge detection (-e).\n");
+        return 1;
+    }
+
+    // Dithering only applies to indexed output
+    if (format.dither && !format.indexed && !format.rle) {
+        printf("--dither requires --indexed or --rle.\n");
+        return 1;
+    }
+
+    // Sequence frames depend on each other, so they can't be served one at a time from the cache
+    if (cacheDir != NULL && sequence) {
+        printf("--cache can't be combined with --sequence.\n");
+        return 1;
+    }
+
     // Ensure proper usage
     if (seamCarving) {
         // For seam carving: ./filter -s 50 infile outfile
         if (argc != optind + 2) {
-            printf("Usage for seam carving: ./filter -s percentage infile outfile\n");
+            printf("Usage for seam carving: ./filter -s percentage [--deadline-ms ms] infile outfile\n");
+            printf("Usage for sequences: ./filter [flag] --sequence first inpattern outpattern\n");
             return 3;
         }
     } else {
         // For other filters: ./filter -flag infile outfile
         if (argc != optind + 2) {
             printf("Usage: ./filter [flag] infile outfile\n");
-            printf("Usage for seam carving: ./filter -s percentage infile outfile\n");
+            printf("Usage for equalization: ./filter -H rgb|luma infile outfile\n");
+            printf("Usage for median: ./filter -m radius infile outfile\n");
+            printf("Usage for seam carving: ./filter -s percentage [--deadline-ms ms] infile outfile\n");
+            printf("Usage for sequences: ./filter [flag] --sequence first inpattern outpattern\n");
+            printf("Result cache: ./filter [flag] --cache dir [--cache-max-mb mb] infile outfile\n");
+            printf("8-bit output: ./filter [flag] --indexed [--dither] [--rle] infile outfile\n");
+            printf("Gray edges: ./filter -e --gray-edges [--indexed] infile outfile\n");
             return 3;
         }
     }
@@ -63,170 +420,63 @@ int main(int argc, char *argv[])
     char *infile = argv[optind];
     char *outfile = argv[optind + 1];
 
-    // Open input file
-    FILE *inptr = fopen(infile, "r");
-    if (inptr == NULL)
-    {
-        printf("Could not open %s.\n", infile);
-        return 4;
-    }
-
-    // Open output file
-    FILE *outptr = fopen(outfile, "w");
-    if (outptr == NULL)
-    {
-        fclose(inptr);
-        printf("Could not create %s.\n", outfile);
-        return 5;
+    // Sequence mode: infile and outfile are patterns such as frame%04d.bmp
+    if (sequence) {
+        if (!validPattern(infile) || !validPattern(outfile)) {
+            printf("Sequence patterns must contain exactly one frame number such as %%d or %%04d.\n");
+            return 3;
+        }
+        return runSequence(&options, &format, infile, outfile, firstFrame, seamBand, sceneCut);
     }
 
-    // Read infile's BITMAPFILEHEADER
+    // Read infile
     BITMAPFILEHEADER bf;
-    fread(&bf, sizeof(BITMAPFILEHEADER), 1, inptr);
-
-    // Read infile's BITMAPINFOHEADER (first 40 bytes)
     BITMAPINFOHEADER bi;
-    fread(&bi, sizeof(BITMAPINFOHEADER), 1, inptr);
-
-    // Ensure infile is a valid 24-bit uncompressed BMP (supports BMP 3.0, 4.0, and 5.0)
-    if (bf.bfType != 0x4d42 || bi.biBitCount != 24 || bi.biCompression != 0)
+    RGBTRIPLE *pixels;
+    int status = readBMP(infile, &bf, &bi, &pixels);
+    if (status != 0)
     {
-        fclose(outptr);
-        fclose(inptr);
-        printf("Unsupported file format.\n");
-        return 6;
+        return status;
     }
 
-    // Validate header size (must be at least 40 bytes for basic BITMAPINFOHEADER)
-    if (bi.biSize < 40)
-    {
-        fclose(outptr);
-        fclose(inptr);
-        printf("Invalid BMP header size.\n");
-        return 6;
-    }
-
-    // Skip any extended header data (for BMP 4.0/5.0 support)
-    if (bi.biSize > 40)
-    {
-        fseek(inptr, bi.biSize - 40, SEEK_CUR);
-    }
-
-    // Position file pointer at pixel data (handles variable header sizes)
-    fseek(inptr, bf.bfOffBits, SEEK_SET);
-
     // Get image's dimensions
     int height = abs(bi.biHeight);
     int width = bi.biWidth;
-    int newWidth = width; // Track the new width after seam carving
 
-    // Allocate memory for image
-    RGBTRIPLE(*image)[width] = calloc(height, width * sizeof(RGBTRIPLE));
-    
-    // Initialize all pixels to black (0,0,0) to prevent garbage data artifacts
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            image[i][j].rgbtRed = 0;
-            image[i][j].rgbtGreen = 0;
-            image[i][j].rgbtBlue = 0;
+    // Serve the result from the cache if this exact input was already filtered the same way
+    uint64_t key = 0;
+    unsigned long hits, misses;
+    if (cacheDir != NULL) {
+        char params[128];
+        snprintf(params, sizeof(params), "%c %d %ld %d %d %d %d %d %d", options.filter, options.compressPercent,
+                 options.deadlineMs, options.equalizeLuma, options.medianRadius, options.grayEdges,
+                 format.indexed, format.dither, format.rle);
+        key = cacheKey(&bi, pixels, params);
+        if (cacheFetch(cacheDir, key, outfile)) {
+            cacheCount(cacheDir, true, &hits, &misses);
+            printf("Cache hit %016llx (hits: %lu, misses: %lu)\n", (unsigned long long)key, hits, misses);
+            free(pixels);
+            return 0;
         }
     }
-    if (image == NULL)
-    {
-        printf("Not enough memory to store image.\n");
-        fclose(outptr);
-        fclose(inptr);
-        return 7;
-    }
-
-    // Determine padding for scanlines
-    int padding = (4 - (width * sizeof(RGBTRIPLE)) % 4) % 4;
-
-    // Iterate over infile's scanlines
-    for (int i = 0; i < height; i++)
-    {
-        // Read row into pixel array
-        fread(image[i], sizeof(RGBTRIPLE), width, inptr);
-
-        // Skip over padding
-        fseek(inptr, padding, SEEK_CUR);
-    }
 
     // Filter image
-    switch (filter)
-    {
-        // Blur
-        case 'b':
-            blur(height, width, image);
-            break;
-
-        // Edges
-        case 'e':
-            edges(height, width, image);
-            break;
-
-        // Grayscale
-        case 'g':
-            grayscale(height, width, image);
-            break;
-
-        // Reflect
-        case 'r':
-            reflect(height, width, image);
-            break;
-            
-        // Seam carving
-        case 's':
-            newWidth = seamCarve(height, width, image, compressPercent);
-            break;
-    }
+    SeamStrategy strategy;
+    int newWidth = applyFilter(&options, height, width, (RGBTRIPLE (*)[width]) pixels, &strategy);
 
-    // Ensure output is in BMP 3.0 format for maximum compatibility
-    bi.biSize = 40;  // Standard BITMAPINFOHEADER size
-    bf.bfOffBits = 54;  // Standard offset for BMP 3.0
-    
-    // Update width in header for seam carving
-    if (filter == 's') {
-        bi.biWidth = newWidth;
-    }
-    
-    // Recalculate file size for BMP 3.0 format
-    int outputWidth = (filter == 's') ? newWidth : width;
-    int outputPadding = (4 - (outputWidth * sizeof(RGBTRIPLE)) % 4) % 4;
-    int outputImageSize = (outputWidth * sizeof(RGBTRIPLE) + outputPadding) * height;
-    bi.biSizeImage = outputImageSize;
-    bf.bfSize = 54 + outputImageSize;  // 54 bytes for headers + image data
-    
-    // Update padding for writing
-    padding = outputPadding;
-    
-    // Write outfile's BITMAPFILEHEADER
-    fwrite(&bf, sizeof(BITMAPFILEHEADER), 1, outptr);
-
-    // Write outfile's BITMAPINFOHEADER
-    fwrite(&bi, sizeof(BITMAPINFOHEADER), 1, outptr);
-
-    // Write new pixels to outfile
-    // Use newWidth for seam carving, original width for other filters
-    int writeWidth = (filter == 's') ? newWidth : width;
-    
-    for (int i = 0; i < height; i++)
-    {
-        // Write row to outfile
-        fwrite(image[i], sizeof(RGBTRIPLE), writeWidth, outptr);
+    // Write outfile; rows are still width pixels apart after seam carving
+    status = writeOutput(&format, outfile, bf, bi, height, newWidth, width, pixels);
 
-        // Write padding at end of row
-        for (int k = 0; k < padding; k++)
-        {
-            fputc(0x00, outptr);
-        }
+    // A deadline run that had to degrade depends on timing, not just on its inputs, so don't keep it
+    if (cacheDir != NULL && status == 0 && strategy != SEAM_FULL) {
+        printf("Cache skipped: result depends on timing (%s)\n", seamStrategyName(strategy));
+    } else if (cacheDir != NULL && status == 0) {
+        cacheStore(cacheDir, key, outfile, cacheMaxMb * 1024 * 1024);
+        cacheCount(cacheDir, false, &hits, &misses);
+        printf("Cache miss %016llx (hits: %lu, misses: %lu)\n", (unsigned long long)key, hits, misses);
     }
 
     // Free memory for image
-    free(image);
-
-    // Close files
-    fclose(inptr);
-    fclose(outptr);
-    return 0;
-}
\ No newline at end of file
+    free(pixels);
+    return status;
+}
@@ -1,9 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "helpers.h"
 #include <math.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
 
 // Helper function to find minimum of two integers
 int min(int a, int b)
@@ -85,6 +91,58 @@ void blurPixel(int i, int j, int height, int width, RGBTRIPLE original[height][w
     result->rgbtBlue = round((float)blueSum / count);
 }
 
+// INTERIOR KERNELS
+// blurPixel(), edgePixel() and edgeEnergy() are the reference versions and still handle the
+// 1-pixel frame, where neighbours fall outside the image. Every other pixel has all 9 neighbours,
+// so these versions read them straight from the rows above (up), at (mid) and below (down)
+// column j, with no bounds checks or channel switch. Results match the reference bit for bit.
+
+#define BOX_SUM(ch) (up[j-1].ch + up[j].ch + up[j+1].ch + \
+                     mid[j-1].ch + mid[j].ch + mid[j+1].ch + \
+                     down[j-1].ch + down[j].ch + down[j+1].ch)
+
+#define SOBEL_X(ch) (-up[j-1].ch + up[j+1].ch - 2 * mid[j-1].ch + 2 * mid[j+1].ch - down[j-1].ch + down[j+1].ch)
+
+#define SOBEL_Y(ch) (-up[j-1].ch - 2 * up[j].ch - up[j+1].ch + down[j-1].ch + 2 * down[j].ch + down[j+1].ch)
+
+static inline void blurInterior(const RGBTRIPLE *up, const RGBTRIPLE *mid, const RGBTRIPLE *down, int j, RGBTRIPLE *result)
+{
+    result->rgbtRed = round((float)BOX_SUM(rgbtRed) / 9);
+    result->rgbtGreen = round((float)BOX_SUM(rgbtGreen) / 9);
+    result->rgbtBlue = round((float)BOX_SUM(rgbtBlue) / 9);
+}
+
+// Sobel magnitude capped at 255, as in edgePixel()
+static inline int sobelCapped(int gx, int gy)
+{
+    double buffer = sqrt((double)gx * gx + (double)gy * gy);
+    if (buffer > 255) {
+        buffer = 255;
+    }
+    return round(buffer);
+}
+
+static inline void edgeInterior(const RGBTRIPLE *up, const RGBTRIPLE *mid, const RGBTRIPLE *down, int j, RGBTRIPLE *result)
+{
+    result->rgbtRed = sobelCapped(SOBEL_X(rgbtRed), SOBEL_Y(rgbtRed));
+    result->rgbtGreen = sobelCapped(SOBEL_X(rgbtGreen), SOBEL_Y(rgbtGreen));
+    result->rgbtBlue = sobelCapped(SOBEL_X(rgbtBlue), SOBEL_Y(rgbtBlue));
+}
+
+// Summed in red, green, blue order like edgeEnergy() so the doubles come out identical
+static inline double energyInterior(const RGBTRIPLE *up, const RGBTRIPLE *mid, const RGBTRIPLE *down, int j)
+{
+    int gx = SOBEL_X(rgbtRed), gy = SOBEL_Y(rgbtRed);
+    double totalEnergy = sqrt((double)gx * gx + (double)gy * gy);
+    gx = SOBEL_X(rgbtGreen);
+    gy = SOBEL_Y(rgbtGreen);
+    totalEnergy += sqrt((double)gx * gx + (double)gy * gy);
+    gx = SOBEL_X(rgbtBlue);
+    gy = SOBEL_Y(rgbtBlue);
+    totalEnergy += sqrt((double)gx * gx + (double)gy * gy);
+    return totalEnergy;
+}
+
 // Blur image
 // box blur, which works by taking each pixel and, for each color value, giving it a new value by averaging the color values of neighboring pixels
 // new value of each pixel would be the average of the values of all of the pixels that are within 1 row and column of the original pixel (forming a 3x3 box)
@@ -99,11 +157,20 @@ void blur(int height, int width, RGBTRIPLE image[height][width])
         }
     }
 
-    // Apply blur to each pixel
+    // Apply blur to each pixel: reference path on the frame, interior kernel everywhere else
     for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            blurPixel(i, j, height, width, imageCopy, &image[i][j]);
+        if (i == 0 || i == height - 1 || width < 3) {
+            for (int j = 0; j < width; j++) {
+                blurPixel(i, j, height, width, imageCopy, &image[i][j]);
+            }
+            continue;
         }
+        
+        blurPixel(i, 0, height, width, imageCopy, &image[i][0]);
+        for (int j = 1; j < width - 1; j++) {
+            blurInterior(imageCopy[i - 1], imageCopy[i], imageCopy[i + 1], j, &image[i][j]);
+        }
+        blurPixel(i, width - 1, height, width, imageCopy, &image[i][width - 1]);
     }
     return;
 }
@@ -172,15 +239,44 @@ void edges(int height, int width, RGBTRIPLE image[height][width])
         }
     }
 
-    // Apply edge detection to each pixel
+    // Apply edge detection to each pixel: reference path on the frame, interior kernel everywhere else
     for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            edgePixel(i, j, height, width, imageCopy, &image[i][j]);
+        if (i == 0 || i == height - 1 || width < 3) {
+            for (int j = 0; j < width; j++) {
+                edgePixel(i, j, height, width, imageCopy, &image[i][j]);
+            }
+            continue;
+        }
+        
+        edgePixel(i, 0, height, width, imageCopy, &image[i][0]);
+        for (int j = 1; j < width - 1; j++) {
+            edgeInterior(imageCopy[i - 1], imageCopy[i], imageCopy[i + 1], j, &image[i][j]);
         }
+        edgePixel(i, width - 1, height, width, imageCopy, &image[i][width - 1]);
     }
     return;
 }
 
+// Collapse color edges to gray
+// each pixel takes the strongest of its three channels, so an edge in any one channel keeps its full magnitude
+void edgesToGray(int height, int width, RGBTRIPLE image[height][width])
+{
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            BYTE strongest = image[i][j].rgbtRed;
+            if (image[i][j].rgbtGreen > strongest) {
+                strongest = image[i][j].rgbtGreen;
+            }
+            if (image[i][j].rgbtBlue > strongest) {
+                strongest = image[i][j].rgbtBlue;
+            }
+            image[i][j].rgbtRed = strongest;
+            image[i][j].rgbtGreen = strongest;
+            image[i][j].rgbtBlue = strongest;
+        }
+    }
+}
+
 // edge functions
 double gxMatrix(int topLeft, int top, int topRight, int middleLeft, int middle, int middleRight, int bottomLeft, int bottom, int bottomRight)
 {
@@ -284,6 +380,23 @@ double edgeEnergy(int i, int j, int height, int currentWidth, RGBTRIPLE image[he
     return totalEnergy;
 }
 
+// Edge energy for a whole row: edgeEnergy() on the frame, the interior kernel everywhere else
+void energyRow(int i, int height, int currentWidth, RGBTRIPLE image[height][currentWidth], double *energy)
+{
+    if (i == 0 || i == height - 1 || currentWidth < 3) {
+        for (int j = 0; j < currentWidth; j++) {
+            energy[j] = edgeEnergy(i, j, height, currentWidth, image);
+        }
+        return;
+    }
+    
+    energy[0] = edgeEnergy(i, 0, height, currentWidth, image);
+    for (int j = 1; j < currentWidth - 1; j++) {
+        energy[j] = energyInterior(image[i - 1], image[i], image[i + 1], j);
+    }
+    energy[currentWidth - 1] = edgeEnergy(i, currentWidth - 1, height, currentWidth, image);
+}
+
 void findSeam(int height, int currentWidth, RGBTRIPLE image[height][currentWidth], int *seam)
 {
     
@@ -301,14 +414,13 @@ void findSeam(int height, int currentWidth, RGBTRIPLE image[height][currentWidth
     }
     
     // 1. Calculate energy and initialize first row
-    for (int j = 0; j < currentWidth; j++) {
-        M[0][j] = edgeEnergy(0, j, height, currentWidth, image);
-    }
+    energyRow(0, height, currentWidth, image, M[0]);
     
-    // 2. Fill DP table
+    // 2. Fill DP table; each row's energy is computed into place first, then the minimum parent added
     for (int i = 1; i < height; i++) {
+        energyRow(i, height, currentWidth, image, M[i]);
         for (int j = 0; j < currentWidth; j++) {
-            double current_energy = edgeEnergy(i, j, height, currentWidth, image);
+            double current_energy = M[i][j];
             double min_prev = M[i-1][j]; // directly above
             
             // Check diagonal left (only if j > 0)
@@ -390,8 +502,8 @@ int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compres
     printf("Removing %d seams from image of width %d\n", seamsToRemove, width);
     
     // Allocate a separate working buffer that we'll use for computation
-    // This is sized to the original width
-    RGBTRIPLE (*workingImage)[width] = malloc(height * width * sizeof(RGBTRIPLE));
+    // Rows are packed at the current width, so it shrinks along with the image
+    RGBTRIPLE *workingImage = malloc(height * width * sizeof(RGBTRIPLE));
     if (workingImage == NULL) {
         fprintf(stderr, "Failed to allocate memory for working image\n");
         return width;
@@ -400,7 +512,7 @@ int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compres
     // Copy the original image to working buffer
     for (int i = 0; i < height; i++) {
         for (int j = 0; j < width; j++) {
-            workingImage[i][j] = image[i][j];
+            workingImage[i * width + j] = image[i][j];
         }
     }
     
@@ -417,26 +529,10 @@ int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compres
         printf("Removing seam %d/%d (current width: %d)\n", n+1, seamsToRemove, currentWidth);
         
         // Find the minimum energy seam
-        findSeam(height, currentWidth, workingImage, seam);
-        
-        // Remove the seam - shift pixels left
-        for (int i = 0; i < height; i++) {
-            int seamCol = seam[i];
-            
-            // Validate seam position
-            if (seamCol < 0 || seamCol >= currentWidth) {
-                fprintf(stderr, "ERROR: Invalid seam position %d at row %d (currentWidth=%d)\n", 
-                        seamCol, i, currentWidth);
-                continue;
-            }
-            
-            // Shift all pixels to the left starting from the seam position
-            for (int j = seamCol; j < currentWidth - 1; j++) {
-                workingImage[i][j] = workingImage[i][j + 1];
-            }
-        }
-        // I could put this in a function but I'm not sure if it's worth it
+        findSeam(height, currentWidth, (RGBTRIPLE (*)[currentWidth]) workingImage, seam);
         
+        // Remove the seam and repack the rows at the narrower width
+        removeSeam(height, currentWidth, workingImage, seam);
         currentWidth--;
         
         // Sanity check
@@ -446,12 +542,43 @@ int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compres
         }
     }
     
-    // Copy the carved result back to the original image array
+    copyCarved(height, width, image, currentWidth, workingImage);
+
+    free(seam);
+    free(workingImage);
+    return currentWidth; // Return the new width after seam removal
+}
+
+// Remove one pixel per row from a buffer packed at currentWidth, leaving it packed at currentWidth - 1
+// Every destination index is at or before its source index, so a single forward pass is safe
+void removeSeam(int height, int currentWidth, RGBTRIPLE *pixels, const int *seam)
+{
+    int dst = 0;
     for (int i = 0; i < height; i++) {
-        // Copy the remaining pixels
+        int seamCol = seam[i];
+        
+        // Validate seam position
+        if (seamCol < 0 || seamCol >= currentWidth) {
+            fprintf(stderr, "ERROR: Invalid seam position %d at row %d (currentWidth=%d)\n", 
+                    seamCol, i, currentWidth);
+            seamCol = currentWidth - 1;
+        }
+        
+        RGBTRIPLE *row = pixels + i * currentWidth;
         for (int j = 0; j < currentWidth; j++) {
-            image[i][j] = workingImage[i][j];
+            if (j != seamCol) {
+                pixels[dst++] = row[j];
+            }
         }
+    }
+}
+
+// Copy a buffer packed at currentWidth back into the full-width image and black out the removed columns
+void copyCarved(int height, int width, RGBTRIPLE image[height][width], int currentWidth, const RGBTRIPLE *pixels)
+{
+    for (int i = 0; i < height; i++) {
+        // Copy the remaining pixels
+        memcpy(image[i], pixels + i * currentWidth, currentWidth * sizeof(RGBTRIPLE));
         // Clear the removed pixels (set to black)
         for (int j = currentWidth; j < width; j++) {
             image[i][j].rgbtRed = 0;
@@ -459,8 +586,864 @@ int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compres
             image[i][j].rgbtBlue = 0;
         }
     }
+}
+
+// DEADLINE-BUDGETED SEAM CARVING
+
+// Monotonic wall clock in milliseconds
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+const char *seamStrategyName(SeamStrategy strategy)
+{
+    switch (strategy) {
+        case SEAM_FULL: return "full";
+        case SEAM_COARSE: return "coarse energy";
+        case SEAM_MULTI: return "multi-seam";
+        case SEAM_RESAMPLE: return "resample";
+        default: return "unknown";
+    }
+}
 
+// Cheap energy: absolute luminance gradient using only the 4 direct neighbours (edges replicated)
+// Luminance is the integer Rec. 601 approximation (77R + 150G + 29B) / 256
+void coarseEnergy(int height, int currentWidth, const RGBTRIPLE *pixels, int *luma, int *energy)
+{
+    for (int k = 0; k < height * currentWidth; k++) {
+        luma[k] = (77 * pixels[k].rgbtRed + 150 * pixels[k].rgbtGreen + 29 * pixels[k].rgbtBlue) >> 8;
+    }
+    
+    for (int i = 0; i < height; i++) {
+        const int *up = luma + (i > 0 ? i - 1 : i) * currentWidth;
+        const int *row = luma + i * currentWidth;
+        const int *down = luma + (i < height - 1 ? i + 1 : i) * currentWidth;
+        for (int j = 0; j < currentWidth; j++) {
+            int left = row[j > 0 ? j - 1 : j];
+            int right = row[j < currentWidth - 1 ? j + 1 : j];
+            energy[i * currentWidth + j] = abs(right - left) + abs(down[j] - up[j]);
+        }
+    }
+}
+
+// Turn a per-pixel energy map into the cumulative minimum-path table, in place
+void accumulateEnergy(int height, int currentWidth, int *M)
+{
+    for (int i = 1; i < height; i++) {
+        const int *prev = M + (i - 1) * currentWidth;
+        int *row = M + i * currentWidth;
+        for (int j = 0; j < currentWidth; j++) {
+            int min_prev = prev[j];
+            if (j > 0 && prev[j-1] < min_prev) {
+                min_prev = prev[j-1];
+            }
+            if (j < currentWidth-1 && prev[j+1] < min_prev) {
+                min_prev = prev[j+1];
+            }
+            row[j] += min_prev;
+        }
+    }
+}
+
+// Trace up to k seams back through the cumulative table, never reusing a pixel
+// Each seam claims exactly one pixel per row; when all three parents are taken the seam
+// jumps to the nearest free column, which keeps every row shrinking by the same amount
+// Stops early once the clock passes untilMs (always tracing at least one seam); returns the seams traced
+int traceSeams(int height, int currentWidth, const int *M, int k, double untilMs, bool *used)
+{
+    for (int n = 0; n < height * currentWidth; n++) {
+        used[n] = false;
+    }
+    
+    const int *last = M + (height - 1) * currentWidth;
+    bool *lastUsed = used + (height - 1) * currentWidth;
+    int s = 0;
+    while (s < k && (s == 0 || nowMs() < untilMs)) {
+        // Start from the cheapest free column in the last row
+        int j = -1;
+        for (int c = 0; c < currentWidth; c++) {
+            if (!lastUsed[c] && (j < 0 || last[c] < last[j])) {
+                j = c;
+            }
+        }
+        lastUsed[j] = true;
+        
+        for (int i = height - 2; i >= 0; i--) {
+            const int *row = M + i * currentWidth;
+            bool *rowUsed = used + i * currentWidth;
+            int best_j = -1;
+            for (int c = j - 1; c <= j + 1; c++) {
+                if (c >= 0 && c < currentWidth && !rowUsed[c] && (best_j < 0 || row[c] < row[best_j])) {
+                    best_j = c;
+                }
+            }
+            // All parents taken: walk outwards to the closest free pixel
+            for (int d = 2; best_j < 0; d++) {
+                if (j - d >= 0 && !rowUsed[j - d]) {
+                    best_j = j - d;
+                } else if (j + d < currentWidth && !rowUsed[j + d]) {
+                    best_j = j + d;
+                }
+            }
+            rowUsed[best_j] = true;
+            j = best_j;
+        }
+        s++;
+    }
+    return s;
+}
+
+// Drop every marked pixel from a buffer packed at currentWidth; each row must hold the same number of marks
+void removeMarked(int height, int currentWidth, RGBTRIPLE *pixels, const bool *used)
+{
+    int dst = 0;
+    for (int n = 0; n < height * currentWidth; n++) {
+        if (!used[n]) {
+            pixels[dst++] = pixels[n];
+        }
+    }
+}
+
+// Linearly resample every row of a buffer packed at currentWidth down to newWidth, in place
+// Source positions and 8-bit blend weights are computed once per column, not per pixel
+// rowBuffer holds currentWidth pixels; columnMap holds 2 * newWidth ints (positions, then weights)
+void resampleRows(int height, int currentWidth, RGBTRIPLE *pixels, int newWidth, RGBTRIPLE *rowBuffer, int *columnMap)
+{
+    int *weight = columnMap + newWidth;
+    double scale = (double)currentWidth / newWidth;
+    for (int x = 0; x < newWidth; x++) {
+        double src = (x + 0.5) * scale - 0.5;
+        if (src < 0) src = 0;
+        if (src > currentWidth - 1) src = currentWidth - 1;
+        columnMap[x] = (int)src;
+        weight[x] = (int)((src - columnMap[x]) * 256 + 0.5);
+        if (columnMap[x] == currentWidth - 1) {
+            weight[x] = 0;
+        }
+    }
+    
+    for (int i = 0; i < height; i++) {
+        // Rows move towards the front of the buffer, so stash the source row first
+        memcpy(rowBuffer, pixels + i * currentWidth, currentWidth * sizeof(RGBTRIPLE));
+        
+        RGBTRIPLE *out = pixels + i * newWidth;
+        for (int x = 0; x < newWidth; x++) {
+            const RGBTRIPLE *a = &rowBuffer[columnMap[x]];
+            const RGBTRIPLE *b = (weight[x] != 0) ? a + 1 : a;
+            int t = weight[x];
+            out[x].rgbtRed = (a->rgbtRed * (256 - t) + b->rgbtRed * t + 128) >> 8;
+            out[x].rgbtGreen = (a->rgbtGreen * (256 - t) + b->rgbtGreen * t + 128) >> 8;
+            out[x].rgbtBlue = (a->rgbtBlue * (256 - t) + b->rgbtBlue * t + 128) >> 8;
+        }
+    }
+}
+
+// Seam carving with a wall-clock budget
+// Before every pass the remaining seams are costed at the current strategy; if they won't fit in
+// what is left of the budget we degrade, never upgrade:
+//   full -> coarse energy -> several seams per DP pass -> plain resample of the remaining width
+// A coarse or multi-seam pass is costed as energy + DP + removal plus a per-seam trace cost, so the
+// seams per pass are capped by what fits; tracing also checks the clock, as the first estimate can be off.
+// The resample and copy-back that finish the job are timed up front and held back from the budget.
+// Costs start from a probe over a few rows and are replaced by measured pass times as we go.
+// The result always has the same width seamCarve() would produce.
+int seamCarveDeadline(int height, int width, RGBTRIPLE image[height][width], int compressPercent, long deadlineMs, SeamStrategy *strategy)
+{
+    *strategy = SEAM_FULL;
+    if (compressPercent <= 0 || compressPercent >= 100) {
+        printf("Invalid compression percentage: %d\n", compressPercent);
+        return width;
+    }
+    
+    int seamsToRemove = (width * compressPercent) / 100;
+    if (seamsToRemove >= width) {
+        seamsToRemove = width - 1;
+    }
+    if (seamsToRemove <= 0) {
+        return width;
+    }
+    
+    double start = nowMs();
+    double deadline = start + deadlineMs;
+    
+    printf("Removing %d seams from image of width %d within %ld ms\n", seamsToRemove, width, deadlineMs);
+    
+    RGBTRIPLE *workingImage = malloc(height * width * sizeof(RGBTRIPLE));
+    int *seam = malloc(height * sizeof(int));
+    int *luma = malloc(height * width * sizeof(int));
+    int *M = malloc(height * width * sizeof(int));
+    bool *used = malloc(height * width * sizeof(bool));
+    // Resample fallback: one source row, plus a column map and blend weights for each output column
+    RGBTRIPLE *rowBuffer = malloc(width * sizeof(RGBTRIPLE));
+    int *columnMap = malloc(2 * width * sizeof(int));
+    if (workingImage == NULL || seam == NULL || luma == NULL || M == NULL || used == NULL ||
+        rowBuffer == NULL || columnMap == NULL) {
+        fprintf(stderr, "Failed to allocate memory for seam carving\n");
+        free(workingImage);
+        free(seam);
+        free(luma);
+        free(M);
+        free(used);
+        free(rowBuffer);
+        free(columnMap);
+        return width;
+    }
+    
+    memcpy(workingImage, image, height * width * sizeof(RGBTRIPLE));
+    
+    int currentWidth = width;
+    int targetWidth = width - seamsToRemove;
+    
+    // Probe: time each step over a strip of rows in the middle of the image and scale up by height
+    int probeRows = min(4, height);
+    int probeStart = (height - probeRows) / 2;
+    double scale = (double)height / probeRows;
+    
+    // Full energy (the DP on top of it is small in comparison)
+    // Without a probe buffer the full strategy is never costed as affordable
+    double fullCost = INFINITY;
+    double *probeRow = malloc(width * sizeof(double));
+    if (probeRow != NULL) {
+        double t0 = nowMs();
+        for (int i = probeStart; i < probeStart + probeRows; i++) {
+            energyRow(i, height, width, (RGBTRIPLE (*)[width]) workingImage, probeRow);
+        }
+        fullCost = (nowMs() - t0) * scale;
+        free(probeRow);
+    }
+    
+    // Coarse pass and fallback, timed on a copy of the strip so the working buffer is left untouched
+    // Without the copy nothing but resampling is costed as affordable, with a tenth of the budget held back
+    double coarseBase = INFINITY;
+    double seamCost = INFINITY;
+    double removeCost = 0;
+    double reserve = 1.0 + deadlineMs * 0.1;
+    RGBTRIPLE *probePixels = malloc(2 * probeRows * width * sizeof(RGBTRIPLE));
+    if (probePixels != NULL) {
+        // A pass is energy, DP and removal, plus one trace per seam; a trace scans the last row and then
+        // steps through every row, so scale the probed trace by the pixels it visits rather than by height
+        int probeSeams = min(8, width);
+        memcpy(probePixels, workingImage + probeStart * width, probeRows * width * sizeof(RGBTRIPLE));
+        double t0 = nowMs();
+        coarseEnergy(probeRows, width, probePixels, luma, M);
+        accumulateEnergy(probeRows, width, M);
+        double t1 = nowMs();
+        traceSeams(probeRows, width, M, probeSeams, INFINITY, used);
+        double t2 = nowMs();
+        removeMarked(probeRows, width, probePixels, used);
+        // The strip stays in cache while a full pass streams the whole image, so double the estimates
+        removeCost = 2 * (nowMs() - t2) * scale;
+        coarseBase = 2 * (t1 - t0) * scale + removeCost;
+        seamCost = (t2 - t1) / probeSeams * (width + 3.0 * height) / (width + 3.0 * probeRows);
+        
+        // Reserve the fallback itself: resampling the rows and copying the result back both scale with
+        // the pixel count (plus a quarter, as a safety margin)
+        memcpy(probePixels, workingImage + probeStart * width, probeRows * width * sizeof(RGBTRIPLE));
+        t0 = nowMs();
+        resampleRows(probeRows, width, probePixels, targetWidth, rowBuffer, columnMap);
+        copyCarved(probeRows, width, (RGBTRIPLE (*)[width]) (probePixels + probeRows * width), targetWidth, probePixels);
+        reserve = 1.0 + 1.25 * (nowMs() - t0) * scale;
+        free(probePixels);
+    }
+    
+    fullCost = fmax(fullCost, 0.001);
+    coarseBase = fmax(coarseBase, 0.001);
+    seamCost = fmax(seamCost, 0.0001);
+    
+    int removedBy[SEAM_RESAMPLE + 1] = {0};
+    SeamStrategy level = SEAM_FULL;
+    
+    while (currentWidth > targetWidth) {
+        int remaining = currentWidth - targetWidth;
+        double left = deadline - nowMs() - reserve;
+        
+        // Pick the most faithful strategy that still fits, never going back up
+        // A coarse or multi-seam pass costs coarseBase plus seamCost for every seam it traces
+        int perPass = 1;
+        double multiPasses = (left - remaining * seamCost) / coarseBase;
+        if (level <= SEAM_FULL && remaining * fullCost <= left) {
+            level = SEAM_FULL;
+        } else if (level <= SEAM_COARSE && remaining * (coarseBase + seamCost) <= left) {
+            level = SEAM_COARSE;
+        } else if (multiPasses >= 1) {
+            // Fewest seams per pass that still lets every remaining pass fit
+            level = SEAM_MULTI;
+            int passes = (int)fmin(multiPasses, remaining);
+            perPass = (remaining + passes - 1) / passes;
+        } else {
+            level = SEAM_RESAMPLE;
+        }
+        
+        if (level == SEAM_FULL) {
+            double passStart = nowMs();
+            findSeam(height, currentWidth, (RGBTRIPLE (*)[currentWidth]) workingImage, seam);
+            removeSeam(height, currentWidth, workingImage, seam);
+            // Clock granularity can report zero on tiny images; keep the estimates positive
+            fullCost = fmax(nowMs() - passStart, 0.001);
+        } else if (level != SEAM_RESAMPLE) {
+            // Coarse and multi-seam share the same pass; coarse just traces a single seam
+            double passStart = nowMs();
+            coarseEnergy(height, currentWidth, workingImage, luma, M);
+            accumulateEnergy(height, currentWidth, M);
+            // The per-seam estimate can be far off before the first real pass, so tracing also stops
+            // wherever the removal would no longer fit in the budget
+            double traceStart = nowMs();
+            perPass = traceSeams(height, currentWidth, M, perPass, deadline - reserve - removeCost, used);
+            double traceEnd = nowMs();
+            removeMarked(height, currentWidth, workingImage, used);
+            removeCost = nowMs() - traceEnd;
+            coarseBase = fmax(traceStart - passStart + removeCost, 0.001);
+            seamCost = fmax((traceEnd - traceStart) / perPass, 0.0001);
+        } else {
+            resampleRows(height, currentWidth, workingImage, targetWidth, rowBuffer, columnMap);
+            perPass = remaining;
+        }
+        
+        removedBy[level] += perPass;
+        currentWidth -= perPass;
+    }
+    
+    copyCarved(height, width, image, currentWidth, workingImage);
+    
+    printf("Removed %d seams in %.0f ms (full: %d, coarse: %d, multi-seam: %d, resampled: %d)\n",
+           seamsToRemove, nowMs() - start, removedBy[SEAM_FULL], removedBy[SEAM_COARSE],
+           removedBy[SEAM_MULTI], removedBy[SEAM_RESAMPLE]);
+    
+    *strategy = level;
+    free(workingImage);
     free(seam);
+    free(luma);
+    free(M);
+    free(used);
+    free(rowBuffer);
+    free(columnMap);
+    return currentWidth;
+}
+
+// TONAL CORRECTION
+// Both filters make two passes over the image: a histogram pass, where every thread counts its strip
+// of rows into private bins that are summed afterwards (no shared counters, no atomics), and a remap
+// pass through a 256-entry lookup table built from the merged histogram.
+
+// Rows per thread below which spawning more threads isn't worth it
+#define MIN_STRIP_ROWS 32
+#define MAX_THREADS 16
+
+typedef struct
+{
+    RGBTRIPLE *pixels;
+    int rowStart;
+    int rowEnd;
+    int width;
+    bool luma;                  // histogram/remap luminance instead of each channel
+    unsigned int hist[3][256];  // private bins; only hist[0] is used in luma mode
+    const BYTE (*lut)[256];     // remap tables, shared read-only
+} ToneJob;
+
+// Integer Rec. 601 luminance, same weights as coarseEnergy()
+static inline int lumaOf(RGBTRIPLE p)
+{
+    return (77 * p.rgbtRed + 150 * p.rgbtGreen + 29 * p.rgbtBlue) >> 8;
+}
+
+static void *histogramWorker(void *arg)
+{
+    ToneJob *job = arg;
+    for (int c = 0; c < 3; c++) {
+        for (int v = 0; v < 256; v++) {
+            job->hist[c][v] = 0;
+        }
+    }
+    
+    RGBTRIPLE *p = job->pixels + job->rowStart * job->width;
+    RGBTRIPLE *end = job->pixels + job->rowEnd * job->width;
+    if (job->luma) {
+        for (; p < end; p++) {
+            job->hist[0][lumaOf(*p)]++;
+        }
+    } else {
+        for (; p < end; p++) {
+            job->hist[0][p->rgbtRed]++;
+            job->hist[1][p->rgbtGreen]++;
+            job->hist[2][p->rgbtBlue]++;
+        }
+    }
+    return NULL;
+}
+
+static void *remapWorker(void *arg)
+{
+    ToneJob *job = arg;
+    const BYTE (*lut)[256] = job->lut;
+    
+    RGBTRIPLE *p = job->pixels + job->rowStart * job->width;
+    RGBTRIPLE *end = job->pixels + job->rowEnd * job->width;
+    if (job->luma) {
+        // Shift all three channels by the luminance change so hue and saturation are kept
+        for (; p < end; p++) {
+            int y = lumaOf(*p);
+            int delta = lut[0][y] - y;
+            int r = p->rgbtRed + delta;
+            int g = p->rgbtGreen + delta;
+            int b = p->rgbtBlue + delta;
+            p->rgbtRed = r < 0 ? 0 : (r > 255 ? 255 : r);
+            p->rgbtGreen = g < 0 ? 0 : (g > 255 ? 255 : g);
+            p->rgbtBlue = b < 0 ? 0 : (b > 255 ? 255 : b);
+        }
+    } else {
+        for (; p < end; p++) {
+            p->rgbtRed = lut[0][p->rgbtRed];
+            p->rgbtGreen = lut[1][p->rgbtGreen];
+            p->rgbtBlue = lut[2][p->rgbtBlue];
+        }
+    }
+    return NULL;
+}
+
+// Number of worker threads for an image of the given height
+static int toneThreadCount(int height)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = (cpus > 0) ? (int)cpus : 1;
+    threads = min(threads, MAX_THREADS);
+    threads = min(threads, height / MIN_STRIP_ROWS);
+    return (threads > 0) ? threads : 1;
+}
+
+// Run worker over every job, one thread per strip; the calling thread takes the first strip
+// Falls back to running a strip inline if a thread can't be created
+static void runToneJobs(ToneJob *jobs, int count, void *(*worker)(void *))
+{
+    pthread_t threads[MAX_THREADS];
+    bool started[MAX_THREADS];
+    
+    for (int t = 1; t < count; t++) {
+        started[t] = (pthread_create(&threads[t], NULL, worker, &jobs[t]) == 0);
+        if (!started[t]) {
+            worker(&jobs[t]);
+        }
+    }
+    worker(&jobs[0]);
+    for (int t = 1; t < count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+}
+
+// Split the image into strips, build the merged histogram, let buildLut fill the tables, then remap
+static void toneCorrect(int height, int width, RGBTRIPLE image[height][width], bool luma,
+                        void (*buildLut)(unsigned int hist[3][256], int channels, unsigned long total, BYTE lut[3][256]))
+{
+    ToneJob jobs[MAX_THREADS];
+    int count = toneThreadCount(height);
+    for (int t = 0; t < count; t++) {
+        jobs[t].pixels = &image[0][0];
+        jobs[t].rowStart = (int)((long)height * t / count);
+        jobs[t].rowEnd = (int)((long)height * (t + 1) / count);
+        jobs[t].width = width;
+        jobs[t].luma = luma;
+    }
+    
+    // Pass 1: private histograms, merged once at the end
+    runToneJobs(jobs, count, histogramWorker);
+    unsigned int hist[3][256] = {{0}};
+    for (int t = 0; t < count; t++) {
+        for (int c = 0; c < 3; c++) {
+            for (int v = 0; v < 256; v++) {
+                hist[c][v] += jobs[t].hist[c][v];
+            }
+        }
+    }
+    
+    // Pass 2: remap through the lookup tables
+    BYTE lut[3][256];
+    buildLut(hist, luma ? 1 : 3, (unsigned long)height * width, lut);
+    for (int t = 0; t < count; t++) {
+        jobs[t].lut = (const BYTE (*)[256]) lut;
+    }
+    runToneJobs(jobs, count, remapWorker);
+}
+
+// Equalization: map each value through the normalized cumulative histogram
+static void equalizeLut(unsigned int hist[3][256], int channels, unsigned long total, BYTE lut[3][256])
+{
+    for (int c = 0; c < channels; c++) {
+        unsigned long cdf = 0;
+        unsigned long cdfMin = 0;
+        for (int v = 0; v < 256; v++) {
+            cdf += hist[c][v];
+            if (cdfMin == 0) {
+                cdfMin = cdf;
+            }
+            // A single-valued channel has nothing to spread out
+            if (total == cdfMin) {
+                lut[c][v] = v;
+            } else {
+                lut[c][v] = round((double)(cdf - cdfMin) * 255 / (total - cdfMin));
+            }
+        }
+    }
+}
+
+// Auto-levels: stretch each channel so the darkest and brightest 0.5% clip to 0 and 255
+static void levelsLut(unsigned int hist[3][256], int channels, unsigned long total, BYTE lut[3][256])
+{
+    unsigned long clip = total / 200;
+    for (int c = 0; c < channels; c++) {
+        int low = 0;
+        unsigned long below = hist[c][0];
+        while (low < 255 && below <= clip) {
+            below += hist[c][++low];
+        }
+        int high = 255;
+        unsigned long above = hist[c][255];
+        while (high > 0 && above <= clip) {
+            above += hist[c][--high];
+        }
+        
+        for (int v = 0; v < 256; v++) {
+            if (high <= low) {
+                lut[c][v] = v;
+            } else if (v <= low) {
+                lut[c][v] = 0;
+            } else if (v >= high) {
+                lut[c][v] = 255;
+            } else {
+                lut[c][v] = round((double)(v - low) * 255 / (high - low));
+            }
+        }
+    }
+}
+
+// Histogram equalization, either per channel or on luminance only
+void equalize(int height, int width, RGBTRIPLE image[height][width], bool luma)
+{
+    toneCorrect(height, width, image, luma, equalizeLut);
+}
+
+// Auto-levels (per-channel contrast stretch)
+void autoLevels(int height, int width, RGBTRIPLE image[height][width])
+{
+    toneCorrect(height, width, image, false, levelsLut);
+}
+
+// MEDIAN FILTER
+// Constant-time median after Perreault & Hebert: one histogram per image column covering the 2R+1
+// rows around the current row, and a kernel histogram that slides along the row by adding the
+// column entering on the right and subtracting the one leaving on the left. Histograms are
+// two-level (16 coarse bins of 16 fine bins each). Only the coarse level is slid every pixel; a
+// fine segment is brought up to date lazily, when the median search actually lands in it.
+// Neighbours outside the image are left out of the window, as in blur().
+
+#define MEDIAN_COARSE 16
+
+typedef struct
+{
+    uint16_t coarse[3][MEDIAN_COARSE];
+    uint16_t fine[3][256];
+} MedianHistogram;
+
+static inline void histogramAdd(MedianHistogram *h, RGBTRIPLE p, int sign)
+{
+    h->coarse[0][p.rgbtRed >> 4] += sign;
+    h->coarse[1][p.rgbtGreen >> 4] += sign;
+    h->coarse[2][p.rgbtBlue >> 4] += sign;
+    h->fine[0][p.rgbtRed] += sign;
+    h->fine[1][p.rgbtGreen] += sign;
+    h->fine[2][p.rgbtBlue] += sign;
+}
+
+// Slide one fine segment of the kernel to the window centred on column j
+static void refreshSegment(MedianHistogram *kernel, int *updatedAt, int c, int k, int j, int radius, int width, const MedianHistogram *columns)
+{
+    uint16_t *segment = &kernel->fine[c][k * MEDIAN_COARSE];
+    int last = updatedAt[c * MEDIAN_COARSE + k];
+    
+    if (j - last > 2 * radius + 1) {
+        // Too stale to slide: rebuild from the columns in the window
+        for (int v = 0; v < MEDIAN_COARSE; v++) {
+            segment[v] = 0;
+        }
+        for (int col = (j - radius > 0 ? j - radius : 0); col <= j + radius && col < width; col++) {
+            const uint16_t *src = &columns[col].fine[c][k * MEDIAN_COARSE];
+            for (int v = 0; v < MEDIAN_COARSE; v++) {
+                segment[v] += src[v];
+            }
+        }
+    } else {
+        for (int centre = last + 1; centre <= j; centre++) {
+            if (centre + radius < width) {
+                const uint16_t *src = &columns[centre + radius].fine[c][k * MEDIAN_COARSE];
+                for (int v = 0; v < MEDIAN_COARSE; v++) {
+                    segment[v] += src[v];
+                }
+            }
+            if (centre - radius - 1 >= 0) {
+                const uint16_t *src = &columns[centre - radius - 1].fine[c][k * MEDIAN_COARSE];
+                for (int v = 0; v < MEDIAN_COARSE; v++) {
+                    segment[v] -= src[v];
+                }
+            }
+        }
+    }
+    updatedAt[c * MEDIAN_COARSE + k] = j;
+}
+
+// Find the value of the given rank (0-based) in one channel of the kernel
+static int kernelRank(MedianHistogram *kernel, int *updatedAt, int c, int rank, int j, int radius, int width, const MedianHistogram *columns)
+{
+    int k = 0;
+    int seen = 0;
+    while (seen + kernel->coarse[c][k] <= rank) {
+        seen += kernel->coarse[c][k];
+        k++;
+    }
+    
+    refreshSegment(kernel, updatedAt, c, k, j, radius, width, columns);
+    const uint16_t *segment = &kernel->fine[c][k * MEDIAN_COARSE];
+    int v = 0;
+    while (seen + segment[v] <= rank) {
+        seen += segment[v];
+        v++;
+    }
+    return k * MEDIAN_COARSE + v;
+}
+
+// Median filter with a (2R+1)x(2R+1) window
+void median(int height, int width, RGBTRIPLE image[height][width], int radius)
+{
+    // Copy the original image; too large for the stack at HD sizes
+    RGBTRIPLE (*imageCopy)[width] = malloc(height * width * sizeof(RGBTRIPLE));
+    MedianHistogram *columns = calloc(width, sizeof(MedianHistogram));
+    if (imageCopy == NULL || columns == NULL) {
+        fprintf(stderr, "Failed to allocate memory for median filter\n");
+        free(imageCopy);
+        free(columns);
+        return;
+    }
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            imageCopy[i][j] = image[i][j];
+        }
+    }
+    
+    // Column histograms start out covering rows 0..R-1; each row adds i+R and drops i-R-1
+    for (int i = 0; i < radius && i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            histogramAdd(&columns[j], imageCopy[i][j], 1);
+        }
+    }
+    
+    MedianHistogram kernel;
+    int updatedAt[3 * MEDIAN_COARSE];
+    
+    for (int i = 0; i < height; i++) {
+        if (i + radius < height) {
+            for (int j = 0; j < width; j++) {
+                histogramAdd(&columns[j], imageCopy[i + radius][j], 1);
+            }
+        }
+        if (i - radius - 1 >= 0) {
+            for (int j = 0; j < width; j++) {
+                histogramAdd(&columns[j], imageCopy[i - radius - 1][j], -1);
+            }
+        }
+        int rows = min(i + radius, height - 1) - (i - radius > 0 ? i - radius : 0) + 1;
+        
+        // Kernel coarse level starts out covering columns 0..R-1; fine segments are all stale
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < MEDIAN_COARSE; k++) {
+                kernel.coarse[c][k] = 0;
+                updatedAt[c * MEDIAN_COARSE + k] = INT_MIN / 2;
+            }
+        }
+        for (int col = 0; col < radius && col < width; col++) {
+            for (int c = 0; c < 3; c++) {
+                for (int k = 0; k < MEDIAN_COARSE; k++) {
+                    kernel.coarse[c][k] += columns[col].coarse[c][k];
+                }
+            }
+        }
+        
+        for (int j = 0; j < width; j++) {
+            if (j + radius < width) {
+                for (int c = 0; c < 3; c++) {
+                    for (int k = 0; k < MEDIAN_COARSE; k++) {
+                        kernel.coarse[c][k] += columns[j + radius].coarse[c][k];
+                    }
+                }
+            }
+            if (j - radius - 1 >= 0) {
+                for (int c = 0; c < 3; c++) {
+                    for (int k = 0; k < MEDIAN_COARSE; k++) {
+                        kernel.coarse[c][k] -= columns[j - radius - 1].coarse[c][k];
+                    }
+                }
+            }
+            int cols = min(j + radius, width - 1) - (j - radius > 0 ? j - radius : 0) + 1;
+            int rank = rows * cols / 2;
+            
+            image[i][j].rgbtRed = kernelRank(&kernel, updatedAt, 0, rank, j, radius, width, columns);
+            image[i][j].rgbtGreen = kernelRank(&kernel, updatedAt, 1, rank, j, radius, width, columns);
+            image[i][j].rgbtBlue = kernelRank(&kernel, updatedAt, 2, rank, j, radius, width, columns);
+        }
+    }
+    
+    free(columns);
+    free(imageCopy);
+}
+
+// FRAME SEQUENCES
+// Consecutive frames of a sequence usually share most of their seams, so each seam of the previous
+// frame guides the search for the same seam in the next one: the DP only looks at a narrow band of
+// columns around it. That makes each search O(height * band) instead of O(height * width) and
+// keeps seams from jumping between frames.
+
+// Mean absolute difference per channel sample between two frames of the same size
+double frameDifference(int height, int width, RGBTRIPLE a[height][width], RGBTRIPLE b[height][width])
+{
+    unsigned long total = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            total += abs(a[i][j].rgbtRed - b[i][j].rgbtRed);
+            total += abs(a[i][j].rgbtGreen - b[i][j].rgbtGreen);
+            total += abs(a[i][j].rgbtBlue - b[i][j].rgbtBlue);
+        }
+    }
+    return (double)total / ((double)height * width * 3);
+}
+
+// Edge energy of one pixel, through the interior kernel when it has all 9 neighbours
+static inline double pixelEnergy(int i, int j, int height, int currentWidth, RGBTRIPLE image[height][currentWidth])
+{
+    if (i > 0 && i < height - 1 && j > 0 && j < currentWidth - 1) {
+        return energyInterior(image[i - 1], image[i], image[i + 1], j);
+    }
+    return edgeEnergy(i, j, height, currentWidth, image);
+}
+
+// findSeam() restricted to band columns either side of a guide seam
+// Parents are compared in the same order as findSeam(), so ties break the same way
+void findSeamBanded(int height, int currentWidth, RGBTRIPLE image[height][currentWidth], const int *guide, int band, int *seam)
+{
+    int span = 2 * band + 1;
+    double (*M)[span] = malloc(height * span * sizeof(double));
+    int *lo = malloc(height * sizeof(int));
+    if (M == NULL || lo == NULL) {
+        free(M);
+        free(lo);
+        findSeam(height, currentWidth, image, seam);
+        return;
+    }
+    
+    // Band for row i is columns lo[i]..hi(i), clipped to the image
+    for (int i = 0; i < height; i++) {
+        lo[i] = (guide[i] - band > 0) ? guide[i] - band : 0;
+    }
+    #define BAND_HI(i) min(guide[i] + band, currentWidth - 1)
+    
+    for (int j = lo[0]; j <= BAND_HI(0); j++) {
+        M[0][j - lo[0]] = pixelEnergy(0, j, height, currentWidth, image);
+    }
+    
+    for (int i = 1; i < height; i++) {
+        int prevLo = lo[i-1], prevHi = BAND_HI(i-1);
+        for (int j = lo[i]; j <= BAND_HI(i); j++) {
+            double min_prev = INFINITY;
+            if (j >= prevLo && j <= prevHi) {
+                min_prev = M[i-1][j - prevLo];
+            }
+            if (j - 1 >= prevLo && j - 1 <= prevHi && M[i-1][j - 1 - prevLo] < min_prev) {
+                min_prev = M[i-1][j - 1 - prevLo];
+            }
+            if (j + 1 >= prevLo && j + 1 <= prevHi && M[i-1][j + 1 - prevLo] < min_prev) {
+                min_prev = M[i-1][j + 1 - prevLo];
+            }
+            M[i][j - lo[i]] = pixelEnergy(i, j, height, currentWidth, image) + min_prev;
+        }
+    }
+    
+    // Cheapest end point in the last row's band, then trace back inside the bands
+    int last = height - 1;
+    int min_col = lo[last];
+    for (int j = lo[last] + 1; j <= BAND_HI(last); j++) {
+        if (M[last][j - lo[last]] < M[last][min_col - lo[last]]) {
+            min_col = j;
+        }
+    }
+    seam[last] = min_col;
+    
+    for (int i = height - 2; i >= 0; i--) {
+        int j = seam[i+1];
+        int best_j = (j < lo[i]) ? lo[i] : min(j, BAND_HI(i));
+        double best_energy = M[i][best_j - lo[i]];
+        
+        if (j - 1 >= lo[i] && j - 1 <= BAND_HI(i) && M[i][j - 1 - lo[i]] < best_energy) {
+            best_j = j - 1;
+            best_energy = M[i][j - 1 - lo[i]];
+        }
+        if (j + 1 >= lo[i] && j + 1 <= BAND_HI(i) && M[i][j + 1 - lo[i]] < best_energy) {
+            best_j = j + 1;
+            best_energy = M[i][j + 1 - lo[i]];
+        }
+        seam[i] = best_j;
+    }
+    #undef BAND_HI
+    
+    free(lo);
+    free(M);
+}
+
+// Seam carving for one frame of a sequence
+// seams has room for every seam this frame removes (height columns each, seam n in the coordinates
+// of the image after n removals). When guided is true it must hold the previous frame's seams and
+// each search stays within band columns of them; either way it returns holding this frame's seams.
+int seamCarveGuided(int height, int width, RGBTRIPLE image[height][width], int compressPercent, int *seams, bool guided, int band)
+{
+    int seamsToRemove = (width * compressPercent) / 100;
+    if (seamsToRemove >= width) {
+        seamsToRemove = width - 1;
+    }
+    if (seamsToRemove <= 0) {
+        return width;
+    }
+    
+    // Each seam is searched into its slot in seams, so the guide is copied out first
+    RGBTRIPLE *workingImage = malloc(height * width * sizeof(RGBTRIPLE));
+    int *guide = malloc(height * sizeof(int));
+    if (workingImage == NULL || guide == NULL) {
+        fprintf(stderr, "Failed to allocate memory for working image\n");
+        free(workingImage);
+        free(guide);
+        return width;
+    }
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            workingImage[i * width + j] = image[i][j];
+        }
+    }
+    
+    int currentWidth = width;
+    for (int n = 0; n < seamsToRemove; n++) {
+        int *seam = seams + n * height;
+        if (guided) {
+            for (int i = 0; i < height; i++) {
+                guide[i] = seam[i];
+            }
+            findSeamBanded(height, currentWidth, (RGBTRIPLE (*)[currentWidth]) workingImage, guide, band, seam);
+        } else {
+            findSeam(height, currentWidth, (RGBTRIPLE (*)[currentWidth]) workingImage, seam);
+        }
+        removeSeam(height, currentWidth, workingImage, seam);
+        currentWidth--;
+    }
+    
+    copyCarved(height, width, image, currentWidth, workingImage);
+    free(guide);
     free(workingImage);
-    return currentWidth; // Return the new width after seam removal
+    return currentWidth;
 }
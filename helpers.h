@@ -1,5 +1,16 @@
+#include <stdbool.h>
+
 #include "bmp.h"
 
+// Seam carving strategies, from most to least faithful
+typedef enum
+{
+    SEAM_FULL,      // Sobel energy, one seam per pass
+    SEAM_COARSE,    // luminance gradient energy, one seam per pass
+    SEAM_MULTI,     // luminance gradient energy, several seams per pass
+    SEAM_RESAMPLE   // linear resample of the remaining width
+} SeamStrategy;
+
 // Convert image to grayscale
 void grayscale(int height, int width, RGBTRIPLE image[height][width]);
 
@@ -9,12 +20,32 @@ void reflect(int height, int width, RGBTRIPLE image[height][width]);
 // Detect edges
 void edges(int height, int width, RGBTRIPLE image[height][width]);
 
+// Collapse color edges to gray (strongest channel per pixel)
+void edgesToGray(int height, int width, RGBTRIPLE image[height][width]);
+
 // Blur image
 void blur(int height, int width, RGBTRIPLE image[height][width]);
 
 // Seam carving
 int seamCarve(int height, int width, RGBTRIPLE image[height][width], int compressPercent);
 
+// Seam carving within a wall-clock budget, degrading strategy as needed
+int seamCarveDeadline(int height, int width, RGBTRIPLE image[height][width], int compressPercent, long deadlineMs, SeamStrategy *strategy);
+const char *seamStrategyName(SeamStrategy strategy);
+
+// Seam carving for one frame of a sequence, optionally searching only near the previous frame's seams
+int seamCarveGuided(int height, int width, RGBTRIPLE image[height][width], int compressPercent, int *seams, bool guided, int band);
+double frameDifference(int height, int width, RGBTRIPLE a[height][width], RGBTRIPLE b[height][width]);
+
+// Median filter over a (2 * radius + 1) square window
+void median(int height, int width, RGBTRIPLE image[height][width], int radius);
+
+// Histogram equalization (per channel, or luminance only when luma is true)
+void equalize(int height, int width, RGBTRIPLE image[height][width], bool luma);
+
+// Auto-levels contrast stretch
+void autoLevels(int height, int width, RGBTRIPLE image[height][width]);
+
 // Helper functions for blur
 void blurPixel(int i, int j, int height, int width, RGBTRIPLE original[height][width], RGBTRIPLE *result);
 
@@ -24,6 +55,17 @@ void edgePixel(int i, int j, int height, int width, RGBTRIPLE original[height][w
 // Seam carving helper functions
 void findSeam(int height, int width, RGBTRIPLE image[height][width], int *seam);
 double edgeEnergy(int i, int j, int height, int width, RGBTRIPLE image[height][width]);
+void energyRow(int i, int height, int width, RGBTRIPLE image[height][width], double *energy);
+void findSeamBanded(int height, int width, RGBTRIPLE image[height][width], const int *guide, int band, int *seam);
+void removeSeam(int height, int currentWidth, RGBTRIPLE *pixels, const int *seam);
+void copyCarved(int height, int width, RGBTRIPLE image[height][width], int currentWidth, const RGBTRIPLE *pixels);
+
+// Degraded seam carving helpers (buffers packed at currentWidth)
+void coarseEnergy(int height, int currentWidth, const RGBTRIPLE *pixels, int *luma, int *energy);
+void accumulateEnergy(int height, int currentWidth, int *M);
+int traceSeams(int height, int currentWidth, const int *M, int k, double untilMs, bool *used);
+void removeMarked(int height, int currentWidth, RGBTRIPLE *pixels, const bool *used);
+void resampleRows(int height, int currentWidth, RGBTRIPLE *pixels, int newWidth, RGBTRIPLE *rowBuffer, int *columnMap);
 
 // Matrix calculation functions for edge detection
 double gxMatrix(int topLeft, int top, int topRight, int middleLeft, int middle, int middleRight, int bottomLeft, int bottom, int bottomRight);